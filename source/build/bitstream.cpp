@@ -6,6 +6,7 @@
 
 #include "args.h"
 #include "help.h"
+#include "cache.h"
 #include "vivano.h"
 #include "vivado.h"
 #include "project.h"
@@ -48,6 +49,16 @@ namespace vvn
 			return Ok(true);
 		}
 
+		auto bit_file = this->get_bitstream_name();
+		auto cache_key = this->bitstream_key();
+		auto artifacts = std::vector<cache::Artifact> { { bit_file.filename().string(), bit_file } };
+
+		if(not force_build && cache::restore(*this, cache::STAGE_BITSTREAM, cache_key, artifacts))
+		{
+			vvn::log("bitstream restored from cache");
+			return Ok(true);
+		}
+
 		zpr::println("");
 		vvn::log("writing bitstream");
 
@@ -71,10 +82,12 @@ namespace vvn
 			}
 		}
 
-		if(vivado.streamCommand("write_bitstream -force \"{}\"", this->get_bitstream_name().string()).has_errors())
+		stdfs::remove(bit_file);
+		if(vivado.streamCommand("write_bitstream -force \"{}\"", bit_file.string()).has_errors())
 			return ErrFmt("failed to write bitstream");
 
-		vvn::log("bitstream written to '{}' in {}", this->get_bitstream_name().string(), timer.print());
+		cache::store(*this, cache::STAGE_BITSTREAM, cache_key, artifacts);
+		vvn::log("bitstream written to '{}' in {}", bit_file.string(), timer.print());
 		return Ok(false);
 	}
 }
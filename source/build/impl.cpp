@@ -6,6 +6,7 @@
 
 #include "args.h"
 #include "help.h"
+#include "cache.h"
 #include "vivano.h"
 #include "vivado.h"
 #include "project.h"
@@ -52,6 +53,16 @@ namespace vvn
 			return Ok(true);
 		}
 
+		auto dcp_file = m_build_folder / m_implemented_dcp_name;
+		auto cache_key = this->implementation_key();
+		auto artifacts = std::vector<cache::Artifact> { { m_implemented_dcp_name, dcp_file } };
+
+		if(not force_build && cache::restore(*this, cache::STAGE_IMPL, cache_key, artifacts))
+		{
+			vvn::log("implementation restored from cache");
+			return Ok(true);
+		}
+
 		zpr::println("");
 		vvn::log("performing implementation");
 
@@ -106,12 +117,14 @@ namespace vvn
 		if(vivado.streamCommand("route_design").has_errors())
 			return ErrFmt("route_design failed");
 
-		auto dcp_file = m_build_folder / m_implemented_dcp_name;
 		vvn::log("writing checkpoint '{}'", dcp_file.string());
+		stdfs::remove(dcp_file);
 
 		if(vivado.streamCommand("write_checkpoint -force \"{}\"", dcp_file.string()).has_errors())
 			return ErrFmt("failed to write post-implementation checkpoint");
 
+		cache::store(*this, cache::STAGE_IMPL, cache_key, artifacts);
+
 		vvn::log("implementation finished in {}", timer.print());
 		return Ok(false);
 	}
@@ -8,6 +8,7 @@
 #include "ip.h"
 #include "args.h"
 #include "help.h"
+#include "cache.h"
 #include "vivano.h"
 #include "vivado.h"
 #include "project.h"
@@ -60,6 +61,16 @@ namespace vvn
 			return Ok(true);
 		}
 
+		auto dcp_file = m_build_folder / m_synthesised_dcp_name;
+		auto cache_key = this->synthesis_key();
+		auto artifacts = std::vector<cache::Artifact> { { m_synthesised_dcp_name, dcp_file } };
+
+		if(not force_build && cache::restore(*this, cache::STAGE_SYNTH, cache_key, artifacts))
+		{
+			vvn::log("synthesis restored from cache");
+			return Ok(true);
+		}
+
 		zpr::println("");
 		vvn::log("performing synthesis");
 
@@ -95,11 +106,14 @@ namespace vvn
 		if(vivado.streamCommand("synth_design -top {} -verbose -assert", m_top_module).has_errors())
 			return ErrFmt("synthesis failed");
 
-		auto dcp_file = m_build_folder / m_synthesised_dcp_name;
+		// the existing checkpoint might be a hardlink into the cache; don't let vivado write through it.
 		vvn::log("writing checkpoint '{}'", dcp_file.string());
+		stdfs::remove(dcp_file);
 		if(vivado.streamCommand("write_checkpoint -force \"{}\"", dcp_file.string()).has_errors())
 			return ErrFmt("failed to write post-synthesis checkpoint");
 
+		cache::store(*this, cache::STAGE_SYNTH, cache_key, artifacts);
+
 		vvn::log("synthesis finished in {}", timer.print());
 		return Ok(false);
 	}
@@ -0,0 +1,498 @@
+// cache.cpp
+// Copyright (c) 2022, zhiayang
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+#if defined(__linux__)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/ioctl.h>
+	#include <linux/fs.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "args.h"
+#include "util.h"
+#include "cache.h"
+#include "vivano.h"
+#include "project.h"
+
+using zst::Ok;
+using zst::Err;
+using zst::ErrFmt;
+using zst::Failable;
+
+namespace vvn::cache
+{
+	enum class Method
+	{
+		Reflink,
+		Hardlink,
+		Copy,
+	};
+
+	static const char* method_name(Method m)
+	{
+		switch(m)
+		{
+			case Method::Reflink: return "reflink";
+			case Method::Hardlink: return "hardlink";
+			case Method::Copy: return "copy";
+		}
+		return "?";
+	}
+
+	static bool try_reflink(const stdfs::path& src, const stdfs::path& dst)
+	{
+	#if defined(__linux__) && defined(FICLONE)
+		auto src_fd = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+		if(src_fd < 0)
+			return false;
+
+		auto dst_fd = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if(dst_fd < 0)
+		{
+			close(src_fd);
+			return false;
+		}
+
+		bool ok = (ioctl(dst_fd, FICLONE, src_fd) == 0);
+		close(src_fd);
+		close(dst_fd);
+
+		if(not ok)
+			unlink(dst.c_str());
+
+		return ok;
+	#else
+		return false;
+	#endif
+	}
+
+	/*
+		Make `dst` have the same contents as `src`, as cheaply as possible. Hardlinks are only used
+		for single-file artifacts (checkpoints and bitstreams), since vivano always unlinks those before
+		asking vivado to write them again; directories (eg. IP outputs) get modified in-place by vivado,
+		so they are never hardlinked.
+	*/
+	static std::optional<Method> clone_file(const stdfs::path& src, const stdfs::path& dst, bool allow_hardlink)
+	{
+		std::error_code ec {};
+		stdfs::remove(dst, ec);
+
+		if(try_reflink(src, dst))
+			return Method::Reflink;
+
+		if(allow_hardlink)
+		{
+			stdfs::create_hard_link(src, dst, ec);
+			if(not ec)
+				return Method::Hardlink;
+		}
+
+		stdfs::copy_file(src, dst, stdfs::copy_options::overwrite_existing, ec);
+		if(ec)
+			return std::nullopt;
+
+		return Method::Copy;
+	}
+
+	static std::optional<Method> clone_tree(const stdfs::path& src, const stdfs::path& dst)
+	{
+		std::error_code ec {};
+		stdfs::create_directories(dst, ec);
+		if(ec)
+			return std::nullopt;
+
+		auto method = Method::Reflink;
+		for(auto it = stdfs::recursive_directory_iterator(src, ec); not ec && it != stdfs::recursive_directory_iterator(); it.increment(ec))
+		{
+			auto target = dst / stdfs::relative(it->path(), src, ec);
+			if(it->is_symlink(ec))
+			{
+				stdfs::copy_symlink(it->path(), target, ec);
+			}
+			else if(it->is_directory(ec))
+			{
+				stdfs::create_directories(target, ec);
+			}
+			else if(auto m = clone_file(it->path(), target, /* allow_hardlink: */ false); m.has_value())
+			{
+				if(*m == Method::Copy)
+					method = Method::Copy;
+			}
+			else
+			{
+				return std::nullopt;
+			}
+
+			if(ec)
+				return std::nullopt;
+		}
+
+		if(ec)
+			return std::nullopt;
+
+		return method;
+	}
+
+	static uint64_t tree_size(const stdfs::path& path)
+	{
+		std::error_code ec {};
+		if(not stdfs::is_directory(path, ec))
+			return stdfs::file_size(path, ec);
+
+		uint64_t total = 0;
+		for(auto it = stdfs::recursive_directory_iterator(path, ec); not ec && it != stdfs::recursive_directory_iterator(); it.increment(ec))
+		{
+			if(it->is_regular_file(ec))
+				total += it->file_size(ec);
+		}
+
+		return total;
+	}
+
+	/*
+		Walk `path` (file or directory) and apply `fn` to every regular file in it.
+	*/
+	template <typename Fn>
+	static void for_each_file(const stdfs::path& path, Fn&& fn)
+	{
+		std::error_code ec {};
+		if(not stdfs::is_directory(path, ec))
+		{
+			fn(path);
+			return;
+		}
+
+		for(auto it = stdfs::recursive_directory_iterator(path, ec); not ec && it != stdfs::recursive_directory_iterator(); it.increment(ec))
+		{
+			if(it->is_regular_file(ec) && not it->is_symlink(ec))
+				fn(it->path());
+		}
+	}
+
+	stdfs::path entry_path(const Config& config, std::string_view stage, std::string_view key)
+	{
+		return config.location / stage / key;
+	}
+
+	stdfs::path make_temp_entry(const Config& config, std::string_view key)
+	{
+		std::error_code ec {};
+		auto tmp = config.location / TMP_FOLDER_NAME / zpr::sprint("{}-{}-{}", key, getpid(),
+			std::hash<std::thread::id>{}(std::this_thread::get_id()));
+		stdfs::remove_all(tmp, ec);
+		stdfs::create_directories(tmp, ec);
+
+		if(ec)
+		{
+			vvn::warn("failed to create cache folder '{}': {}", tmp.string(), ec.message());
+			return {};
+		}
+
+		return tmp;
+	}
+
+	bool commit_entry(const Config& config, std::string_view stage, std::string_view key, const stdfs::path& tmp)
+	{
+		// make the entry read-only, so that anything holding a hardlink to it can't scribble over it.
+		for_each_file(tmp, [](const stdfs::path& p) {
+			std::error_code ec {};
+			stdfs::permissions(p, stdfs::perms::owner_write | stdfs::perms::group_write | stdfs::perms::others_write,
+				stdfs::perm_options::remove, ec);
+		});
+
+		if(auto f = fopen((tmp / ENTRY_SIZE_FILENAME).c_str(), "wb"); f != nullptr)
+		{
+			zpr::fprintln(f, "{}", tree_size(tmp));
+			fclose(f);
+		}
+
+		std::error_code ec {};
+		auto entry = entry_path(config, stage, key);
+		stdfs::create_directories(entry.parent_path(), ec);
+		stdfs::rename(tmp, entry, ec);
+
+		// someone else might have gotten there first; that's fine, since the contents are the same.
+		if(ec)
+		{
+			stdfs::remove_all(tmp, ec);
+			return false;
+		}
+
+		collectGarbage(config);
+		return true;
+	}
+
+
+
+	bool restore(const Project& proj, std::string_view stage, const std::string& key,
+		const std::vector<Artifact>& artifacts)
+	{
+		auto& config = proj.getCacheConfig();
+		if(not config.enabled)
+			return false;
+
+		std::error_code ec {};
+		auto entry = entry_path(config, stage, key);
+		if(not stdfs::exists(entry, ec))
+		{
+			if(config.remote_url.empty() || not fetch_remote(config, stage, key))
+				return false;
+		}
+
+		for(auto& a : artifacts)
+		{
+			if(not stdfs::exists(entry / a.name, ec))
+				return false;
+		}
+
+		auto timer = util::Timer();
+
+		std::vector<Method> methods {};
+		std::vector<stdfs::path> restored {};
+		auto rollback = [&restored]() {
+			std::error_code ec {};
+			for(auto& p : restored)
+				stdfs::remove_all(p, ec);
+		};
+
+		for(auto& a : artifacts)
+		{
+			auto src = entry / a.name;
+
+			stdfs::remove_all(a.path, ec);
+			stdfs::create_directories(a.path.parent_path(), ec);
+			restored.push_back(a.path);
+
+			std::optional<Method> m {};
+			if(stdfs::is_directory(src, ec))
+				m = clone_tree(src, a.path);
+			else
+				m = clone_file(src, a.path, /* allow_hardlink: */ true);
+
+			if(not m.has_value())
+			{
+				vvn::warn("failed to restore '{}' from cache", a.name);
+				rollback();
+				return false;
+			}
+
+			methods.push_back(*m);
+		}
+
+		// give everything we restored a fresh (and identical) timestamp, so that the mtime-based
+		// staleness checks see the restored products as being newer than their inputs. entries
+		// are stored read-only, so also give back write permissions to anything we copied.
+		auto now = stdfs::file_time_type::clock::now();
+		for(size_t i = 0; i < artifacts.size(); i++)
+		{
+			for_each_file(artifacts[i].path, [&](const stdfs::path& p) {
+				std::error_code ec {};
+				if(methods[i] != Method::Hardlink)
+					stdfs::permissions(p, stdfs::perms::owner_write, stdfs::perm_options::add, ec);
+
+				stdfs::last_write_time(p, now, ec);
+			});
+		}
+
+		// bump the entry for LRU purposes
+		stdfs::last_write_time(entry, now, ec);
+
+		for(size_t i = 0; i < artifacts.size(); i++)
+		{
+			zpr::println("{}< {} ({}, {})", indentStr(1),
+				stdfs::relative(artifacts[i].path, proj.getProjectLocation()).string(),
+				method_name(methods[i]), timer.print());
+		}
+
+		return true;
+	}
+
+	void store(const Project& proj, std::string_view stage, const std::string& key,
+		const std::vector<Artifact>& artifacts)
+	{
+		auto& config = proj.getCacheConfig();
+		if(not config.enabled)
+			return;
+
+		std::error_code ec {};
+		auto entry = entry_path(config, stage, key);
+		if(stdfs::exists(entry, ec))
+		{
+			stdfs::last_write_time(entry, stdfs::file_time_type::clock::now(), ec);
+			return;
+		}
+
+		auto tmp = make_temp_entry(config, key);
+		if(tmp.empty())
+			return;
+
+		for(auto& a : artifacts)
+		{
+			std::optional<Method> m {};
+			if(stdfs::is_directory(a.path, ec))
+				m = clone_tree(a.path, tmp / a.name);
+			else if(stdfs::exists(a.path, ec))
+				m = clone_file(a.path, tmp / a.name, /* allow_hardlink: */ true);
+
+			if(not m.has_value())
+			{
+				vvn::warn("failed to insert '{}' into cache", a.path.string());
+				stdfs::remove_all(tmp, ec);
+				return;
+			}
+		}
+
+		if(commit_entry(config, stage, key, tmp) && not config.remote_url.empty() && config.remote_upload)
+			upload_remote_async(config, stage, key);
+	}
+
+
+	struct Entry
+	{
+		stdfs::path path;
+		uint64_t size;
+		stdfs::file_time_type last_used;
+	};
+
+	static std::vector<Entry> list_entries(const Config& config)
+	{
+		std::vector<Entry> entries {};
+
+		std::error_code ec {};
+		for(auto& stage : stdfs::directory_iterator(config.location, ec))
+		{
+			if(not stage.is_directory(ec) || stage.path().filename() == TMP_FOLDER_NAME)
+				continue;
+
+			for(auto& ent : stdfs::directory_iterator(stage.path(), ec))
+			{
+				if(not ent.is_directory(ec))
+					continue;
+
+				Entry e {};
+				e.path = ent.path();
+				e.last_used = ent.last_write_time(ec);
+
+				auto size_file = ent.path() / ENTRY_SIZE_FILENAME;
+				if(auto sz = util::parseU64(util::trim(util::readEntireFile(size_file.string()))); sz.has_value())
+					e.size = *sz;
+				else
+					e.size = tree_size(ent.path());
+
+				entries.push_back(std::move(e));
+			}
+		}
+
+		return entries;
+	}
+
+	void collectGarbage(const Config& config)
+	{
+		auto entries = list_entries(config);
+
+		uint64_t total = 0;
+		for(auto& e : entries)
+			total += e.size;
+
+		if(total <= config.max_size)
+			return;
+
+		std::sort(entries.begin(), entries.end(), [](auto& a, auto& b) {
+			return a.last_used < b.last_used;
+		});
+
+		size_t evicted = 0;
+		for(auto& e : entries)
+		{
+			if(total <= config.max_size)
+				break;
+
+			std::error_code ec {};
+			stdfs::remove_all(e.path, ec);
+			if(not ec)
+			{
+				total -= e.size;
+				evicted++;
+			}
+		}
+
+		vvn::log("evicted {} cache {}", evicted, evicted == 1 ? "entry" : "entries");
+	}
+
+
+
+	Failable<std::string> runCacheCommand(const Project& proj, std::span<std::string_view> args)
+	{
+		auto help_str = R"(
+usage: vvn cache [subcommand]
+
+Subcommands:
+    info            show the location and size of the build cache
+    gc              evict old entries until the cache fits its size limit
+    clear           remove every entry from the build cache
+    serve           run a shared cache server (see 'vvn cache serve --help')
+
+The build cache stores IP output products, design checkpoints and bitstreams,
+keyed by a hash of their inputs. It is shared by every project on this machine,
+and optionally with other machines through a remote cache server.
+)";
+
+		auto& config = proj.getCacheConfig();
+		auto mb = [](uint64_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+
+		if(args.empty() || args::check(args, args::HELP))
+		{
+			puts(help_str);
+			return Ok();
+		}
+		else if(args[0] == CMD_CACHE_INFO)
+		{
+			auto entries = list_entries(config);
+
+			uint64_t total = 0;
+			for(auto& e : entries)
+				total += e.size;
+
+			zpr::println("cache location: {}", config.location.string());
+			zpr::println("cache enabled:  {}", config.enabled);
+			zpr::println("remote cache:   {}{}", config.remote_url.empty() ? "none" : config.remote_url,
+				config.remote_url.empty() || config.remote_upload ? "" : " (download only)");
+			zpr::println("entries:        {}", entries.size());
+			zpr::println("size:           {.1f} / {.1f} MiB", mb(total), mb(config.max_size));
+			return Ok();
+		}
+		else if(args[0] == CMD_CACHE_GC)
+		{
+			collectGarbage(config);
+			return Ok();
+		}
+		else if(args[0] == CMD_CACHE_CLEAR)
+		{
+			vvn::log("clearing build cache at '{}'", config.location.string());
+
+			std::error_code ec {};
+			stdfs::remove_all(config.location, ec);
+			if(ec)
+				return ErrFmt("failed to clear cache: {}", ec.message());
+
+			return Ok();
+		}
+		else
+		{
+			puts(help_str);
+			return ErrFmt("unknown cache subcommand '{}'", args[0]);
+		}
+	}
+}
@@ -0,0 +1,88 @@
+// keys.cpp
+// Copyright (c) 2022, zhiayang
+// SPDX-License-Identifier: Apache-2.0
+
+#include <filesystem>
+
+#include "util.h"
+#include "cache.h"
+#include "vivano.h"
+#include "project.h"
+
+namespace vvn
+{
+	/*
+		Cache keys only depend on the *contents* of the inputs (and their paths relative to the project),
+		never on timestamps, so that the same design in two different worktrees (or the same design after
+		switching branches back and forth) maps to the same key.
+	*/
+	template <typename Container>
+	static void hash_files(util::Sha256& hasher, const stdfs::path& base, std::string_view kind, const Container& files)
+	{
+		hasher.update(kind);
+		for(auto& f : files)
+		{
+			auto path = stdfs::path(f);
+			hasher.update(stdfs::relative(path, base).string());
+			hasher.update(util::hashFile(path).value_or("<missing>"));
+		}
+	}
+
+	static util::Sha256 common_hasher(const Project& proj, std::string_view stage)
+	{
+		auto hasher = util::Sha256();
+		hasher.update("vivano-cache-v1");
+		hasher.update(stage);
+		hasher.update(proj.getVivadoInstallDir().string());
+		hasher.update(proj.getPartName());
+
+		hash_files(hasher, proj.getProjectLocation(), "tcl", proj.getTclScripts());
+		return hasher;
+	}
+
+	std::string IpInstance::cacheKey(const Project& proj) const
+	{
+		auto hasher = common_hasher(proj, cache::STAGE_IP);
+		hasher.update(this->name);
+		hasher.update(this->is_global ? "global" : "ooc");
+
+		// the output location is baked into the generated products, so it needs to be part of the key
+		hasher.update(stdfs::relative(this->xci, proj.getProjectLocation()).string());
+		hash_files(hasher, proj.getProjectLocation(), "ip", std::vector<stdfs::path> { this->tcl });
+
+		return hasher.hexdigest();
+	}
+
+	std::string Project::synthesis_key() const
+	{
+		auto hasher = common_hasher(*this, cache::STAGE_SYNTH);
+		hasher.update(m_top_module);
+
+		hash_files(hasher, m_location, "vhdl", m_vhdl_sources);
+		hash_files(hasher, m_location, "verilog", m_verilog_sources);
+		hash_files(hasher, m_location, "systemverilog", m_systemverilog_sources);
+		hash_files(hasher, m_location, "xdc", m_synth_constraints);
+
+		for(auto& ip : m_ip_instances)
+			hasher.update(ip.cacheKey(*this));
+
+		return hasher.hexdigest();
+	}
+
+	std::string Project::implementation_key() const
+	{
+		auto hasher = common_hasher(*this, cache::STAGE_IMPL);
+		hasher.update(this->synthesis_key());
+
+		hash_files(hasher, m_location, "xdc", m_impl_constraints);
+		return hasher.hexdigest();
+	}
+
+	std::string Project::bitstream_key() const
+	{
+		auto hasher = common_hasher(*this, cache::STAGE_BITSTREAM);
+		hasher.update(this->implementation_key());
+
+		return hasher.hexdigest();
+	}
+}
@@ -0,0 +1,665 @@
+// remote.cpp
+// Copyright (c) 2022, zhiayang
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+#include "util.h"
+#include "cache.h"
+#include "vivano.h"
+#include "remote.h"
+
+using zst::Ok;
+using zst::Err;
+using zst::ErrFmt;
+using zst::Result;
+using zst::Failable;
+
+/*
+	The remote cache protocol is deliberately tiny, so that it can be served by anything (nginx with
+	WebDAV, a python one-liner, or `vvn cache serve`):
+
+		GET /<stage>/<key>      200 with the packed entry as the body, or 404 if it's not there
+		PUT /<stage>/<key>      store the body as the entry for that key
+
+	Both directions carry the SHA-256 of the body in the `X-Vivano-Sha256` header; the receiving side
+	hashes the body as it streams in, and throws it away if the hashes don't agree.
+
+	An entry (which may contain directories, eg. for IP products) is sent as a simple archive:
+
+		vvnpack 1\n
+		d <path>\n
+		f <mode> <size> <path>\n<size bytes of data>
+		end\n
+*/
+namespace vvn::cache::remote
+{
+	static constexpr auto IO_TIMEOUT_SECS = 30;
+
+	bool Socket::sendAll(const void* data, size_t len)
+	{
+		auto bytes = static_cast<const char*>(data);
+		while(len > 0)
+		{
+			auto n = ::send(this->fd, bytes, len, MSG_NOSIGNAL);
+			if(n < 0 && errno == EINTR)
+				continue;
+			else if(n <= 0)
+				return false;
+
+			bytes += n;
+			len -= static_cast<size_t>(n);
+		}
+		return true;
+	}
+
+	bool Socket::sendAll(std::string_view sv)
+	{
+		return this->sendAll(sv.data(), sv.size());
+	}
+
+	bool Socket::fill()
+	{
+		if(m_pos < m_len)
+			return true;
+
+		while(true)
+		{
+			auto n = ::recv(this->fd, &m_buffer[0], sizeof(m_buffer), 0);
+			if(n < 0 && errno == EINTR)
+				continue;
+			else if(n <= 0)
+				return false;
+
+			m_pos = 0;
+			m_len = static_cast<size_t>(n);
+			return true;
+		}
+	}
+
+	size_t Socket::read(void* into, size_t len)
+	{
+		if(len == 0 || not this->fill())
+			return 0;
+
+		auto n = std::min(len, m_len - m_pos);
+		memcpy(into, &m_buffer[m_pos], n);
+		m_pos += n;
+
+		return n;
+	}
+
+	bool Socket::readExactly(void* into, size_t len)
+	{
+		auto bytes = static_cast<char*>(into);
+		while(len > 0)
+		{
+			auto n = this->read(bytes, len);
+			if(n == 0)
+				return false;
+
+			bytes += n;
+			len -= n;
+		}
+		return true;
+	}
+
+	std::optional<std::string> Socket::readLine(size_t max_len)
+	{
+		std::string ret {};
+		while(ret.size() < max_len)
+		{
+			char c = 0;
+			if(this->read(&c, 1) != 1)
+				return std::nullopt;
+
+			if(c == '\n')
+			{
+				if(ret.ends_with('\r'))
+					ret.pop_back();
+
+				return ret;
+			}
+
+			ret.push_back(c);
+		}
+
+		return std::nullopt;
+	}
+
+	Socket::~Socket()
+	{
+		if(this->fd >= 0)
+			::close(this->fd);
+	}
+
+	Socket::Socket(Socket&& other) : fd(other.fd)
+	{
+		other.fd = -1;
+		memcpy(&m_buffer[0], &other.m_buffer[0], sizeof(m_buffer));
+		m_pos = other.m_pos;
+		m_len = other.m_len;
+	}
+
+	void set_timeouts(int fd)
+	{
+		struct timeval tv {};
+		tv.tv_sec = IO_TIMEOUT_SECS;
+
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	}
+
+	std::optional<Request> read_headers(Socket& sock)
+	{
+		auto first = sock.readLine();
+		if(not first.has_value())
+			return std::nullopt;
+
+		Request req {};
+		req.first_line = *first;
+
+		while(true)
+		{
+			auto line = sock.readLine();
+			if(not line.has_value())
+				return std::nullopt;
+			else if(line->empty())
+				break;
+
+			if(auto k = line->find(':'); k != std::string::npos)
+			{
+				auto name = util::lowercase(util::trim(std::string_view(*line).substr(0, k)));
+				req.headers[name] = std::string(util::trim(std::string_view(*line).substr(k + 1)));
+			}
+		}
+
+		return req;
+	}
+
+	std::optional<std::string> Request::header(const std::string& name) const
+	{
+		if(auto it = this->headers.find(name); it != this->headers.end())
+			return it->second;
+
+		return std::nullopt;
+	}
+
+	bool valid_stage_and_key(std::string_view stage, std::string_view key)
+	{
+		if(stage != STAGE_IP && stage != STAGE_SYNTH && stage != STAGE_IMPL && stage != STAGE_BITSTREAM)
+			return false;
+
+		return key.size() == 64 && std::all_of(key.begin(), key.end(), [](char c) {
+			return ('0' <= c && c <= '9') || ('a' <= c && c <= 'f');
+		});
+	}
+
+
+
+
+	Failable<std::string> pack(const stdfs::path& entry, const std::function<bool (const void*, size_t)>& sink)
+	{
+		std::error_code ec {};
+		auto emit = [&](std::string_view sv) { return sink(sv.data(), sv.size()); };
+
+		if(not emit("vvnpack 1\n"))
+			return ErrFmt("write failed");
+
+		for(auto it = stdfs::recursive_directory_iterator(entry, ec); not ec && it != stdfs::recursive_directory_iterator(); it.increment(ec))
+		{
+			auto rel = stdfs::relative(it->path(), entry, ec).generic_string();
+			if(rel == ENTRY_SIZE_FILENAME)
+				continue;
+
+			if(it->is_directory(ec))
+			{
+				if(not emit(zpr::sprint("d {}\n", rel)))
+					return ErrFmt("write failed");
+
+				continue;
+			}
+
+			auto size = it->file_size(ec);
+			auto mode = static_cast<unsigned>(it->status(ec).permissions() & stdfs::perms::mask);
+			if(not emit(zpr::sprint("f {} {} {}\n", mode, size, rel)))
+				return ErrFmt("write failed");
+
+			auto f = fopen(it->path().c_str(), "rb");
+			if(f == nullptr)
+				return ErrFmt("failed to open '{}': {}", it->path().string(), strerror(errno));
+
+			char buf[64 * 1024];
+			uint64_t remaining = size;
+			while(remaining > 0)
+			{
+				auto n = fread(&buf[0], 1, std::min(sizeof(buf), static_cast<size_t>(remaining)), f);
+				if(n == 0 || not sink(&buf[0], n))
+				{
+					fclose(f);
+					return ErrFmt("failed to send '{}'", it->path().string());
+				}
+
+				remaining -= n;
+			}
+
+			fclose(f);
+		}
+
+		if(ec)
+			return ErrFmt("failed to read cache entry: {}", ec.message());
+
+		if(not emit("end\n"))
+			return ErrFmt("write failed");
+
+		return Ok();
+	}
+
+	Failable<std::string> unpack(const stdfs::path& dest, const std::function<std::optional<std::string> ()>& read_line,
+		const std::function<bool (void*, size_t)>& read_bytes)
+	{
+		if(read_line() != "vvnpack 1")
+			return ErrFmt("invalid archive header");
+
+		auto safe_path = [&dest](std::string_view rel) -> std::optional<stdfs::path> {
+			auto p = stdfs::path(rel).lexically_normal();
+			if(p.empty() || p.is_absolute() || p.string().starts_with(".."))
+				return std::nullopt;
+
+			return dest / p;
+		};
+
+		while(true)
+		{
+			auto line = read_line();
+			if(not line.has_value())
+				return ErrFmt("unexpected end of archive");
+			else if(*line == "end")
+				return Ok();
+
+			std::error_code ec {};
+			if(line->starts_with("d "))
+			{
+				auto path = safe_path(std::string_view(*line).substr(2));
+				if(not path.has_value())
+					return ErrFmt("invalid path in archive");
+
+				stdfs::create_directories(*path, ec);
+				continue;
+			}
+
+			if(not line->starts_with("f "))
+				return ErrFmt("invalid archive record");
+
+			auto parts = util::splitString(std::string_view(*line).substr(2), ' ');
+			if(parts.size() < 3)
+				return ErrFmt("invalid archive record");
+
+			auto mode = util::parseInt(parts[0]).value_or(0644);
+			auto size = util::parseU64(parts[1]);
+
+			// the path is everything after the second space, since it might contain spaces
+			auto path = safe_path(std::string_view(*line).substr(2 + parts[0].size() + 1 + parts[1].size() + 1));
+			if(not size.has_value() || not path.has_value())
+				return ErrFmt("invalid archive record");
+
+			stdfs::create_directories(path->parent_path(), ec);
+			auto f = fopen(path->c_str(), "wb");
+			if(f == nullptr)
+				return ErrFmt("failed to create '{}': {}", path->string(), strerror(errno));
+
+			char buf[64 * 1024];
+			uint64_t remaining = *size;
+			while(remaining > 0)
+			{
+				auto n = std::min(sizeof(buf), static_cast<size_t>(remaining));
+				if(not read_bytes(&buf[0], n) || fwrite(&buf[0], 1, n, f) != n)
+				{
+					fclose(f);
+					return ErrFmt("truncated archive");
+				}
+
+				remaining -= n;
+			}
+
+			fclose(f);
+			stdfs::permissions(*path, static_cast<stdfs::perms>(mode) | stdfs::perms::owner_read, ec);
+		}
+	}
+
+
+
+
+	struct Url
+	{
+		std::string host;
+		std::string port;
+		std::string prefix;
+	};
+
+	static std::optional<Url> parse_url(std::string_view url)
+	{
+		if(not url.starts_with("http://"))
+			return std::nullopt;
+
+		url.remove_prefix(7);
+
+		Url ret {};
+		if(auto k = url.find('/'); k != std::string_view::npos)
+		{
+			ret.prefix = std::string(url.substr(k));
+			url = url.substr(0, k);
+		}
+
+		while(ret.prefix.ends_with('/'))
+			ret.prefix.pop_back();
+
+		if(auto k = url.find(':'); k != std::string_view::npos)
+		{
+			ret.host = std::string(url.substr(0, k));
+			ret.port = std::string(url.substr(k + 1));
+		}
+		else
+		{
+			ret.host = std::string(url);
+			ret.port = "80";
+		}
+
+		if(ret.host.empty())
+			return std::nullopt;
+
+		return ret;
+	}
+
+	static Result<Socket, std::string> connect_to(const Url& url)
+	{
+		struct addrinfo hints {};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+
+		struct addrinfo* addrs = nullptr;
+		if(auto e = getaddrinfo(url.host.c_str(), url.port.c_str(), &hints, &addrs); e != 0)
+			return ErrFmt("could not resolve '{}': {}", url.host, gai_strerror(e));
+
+		int fd = -1;
+		for(auto a = addrs; a != nullptr; a = a->ai_next)
+		{
+			fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+			if(fd < 0)
+				continue;
+
+			// linux also applies the send timeout to connect()
+			set_timeouts(fd);
+			if(connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+				break;
+
+			close(fd);
+			fd = -1;
+		}
+
+		freeaddrinfo(addrs);
+		if(fd < 0)
+			return ErrFmt("could not connect to '{}:{}'", url.host, url.port);
+
+		return Ok(Socket(fd));
+	}
+
+	static int parse_status(const std::string& status_line)
+	{
+		// "HTTP/1.1 200 OK"
+		auto parts = util::splitString(status_line, ' ');
+		if(parts.size() < 2 || not parts[0].starts_with("HTTP/"))
+			return -1;
+
+		return util::parseInt(parts[1]).value_or(-1);
+	}
+}
+
+
+
+namespace vvn::cache
+{
+	using namespace remote;
+
+	bool fetch_remote(const Config& config, std::string_view stage, std::string_view key)
+	{
+		auto url = parse_url(config.remote_url);
+		if(not url.has_value())
+		{
+			vvn::warn("invalid remote cache url '{}' (only http:// is supported)", config.remote_url);
+			return false;
+		}
+
+		auto sock_ = connect_to(*url);
+		if(sock_.is_err())
+		{
+			vvn::warn("remote cache: {}", sock_.error());
+			return false;
+		}
+
+		auto timer = util::Timer();
+		auto sock = std::move(sock_.unwrap());
+
+		auto req = zpr::sprint("GET {}/{}/{} HTTP/1.1\r\nHost: {}\r\nConnection: close\r\n\r\n",
+			url->prefix, stage, key, url->host);
+
+		if(not sock.sendAll(req))
+			return false;
+
+		auto resp = read_headers(sock);
+		if(not resp.has_value())
+		{
+			vvn::warn("remote cache: malformed response");
+			return false;
+		}
+
+		if(auto status = parse_status(resp->first_line); status == 404)
+		{
+			return false;
+		}
+		else if(status != 200)
+		{
+			vvn::warn("remote cache: unexpected response '{}'", resp->first_line);
+			return false;
+		}
+
+		auto expected_hash = resp->header("x-vivano-sha256");
+		auto content_length = util::parseU64(resp->header("content-length").value_or(""));
+		if(not expected_hash.has_value() || not content_length.has_value())
+		{
+			vvn::warn("remote cache: response is missing a hash or length");
+			return false;
+		}
+
+		auto tmp = make_temp_entry(config, key);
+		if(tmp.empty())
+			return false;
+
+		// hash the body as we stream it to disk, but don't read past the content-length.
+		auto hasher = util::Sha256();
+		uint64_t remaining = *content_length;
+
+		auto read_bytes = [&](void* buf, size_t len) -> bool {
+			if(len > remaining || not sock.readExactly(buf, len))
+				return false;
+
+			hasher.update(buf, len);
+			remaining -= len;
+			return true;
+		};
+
+		auto read_line = [&]() -> std::optional<std::string> {
+			std::string ret {};
+			char c = 0;
+			while(read_bytes(&c, 1))
+			{
+				if(c == '\n')
+					return ret;
+
+				ret.push_back(c);
+			}
+			return std::nullopt;
+		};
+
+		auto result = unpack(tmp, read_line, read_bytes);
+
+		std::error_code ec {};
+		if(result.is_err() || remaining != 0)
+		{
+			vvn::warn("remote cache: failed to download '{}/{}': {}", stage, key.substr(0, 12),
+				result.is_err() ? result.error() : "trailing data");
+
+			stdfs::remove_all(tmp, ec);
+			return false;
+		}
+		else if(auto h = hasher.hexdigest(); h != *expected_hash)
+		{
+			vvn::warn("remote cache: integrity check failed for '{}/{}' (expected {}, got {})", stage, key.substr(0, 12),
+				expected_hash->substr(0, 12), h.substr(0, 12));
+
+			stdfs::remove_all(tmp, ec);
+			return false;
+		}
+
+		commit_entry(config, stage, key, tmp);
+
+		vvn::log("downloaded '{}/{}' from remote cache ({.1f} MiB in {})", stage, key.substr(0, 12),
+			static_cast<double>(*content_length) / (1024.0 * 1024.0), timer.print());
+		return true;
+	}
+
+	static Failable<std::string> upload_one(const Config& config, const std::string& stage, const std::string& key)
+	{
+		auto url = parse_url(config.remote_url);
+		if(not url.has_value())
+			return ErrFmt("invalid remote cache url '{}'", config.remote_url);
+
+		auto entry = entry_path(config, stage, key);
+
+		// the header needs to go out before the body, so take one pass over the entry to get
+		// the hash and length, then another to actually send it. entries are immutable, so this is fine.
+		auto hasher = util::Sha256();
+		uint64_t length = 0;
+		auto e = pack(entry, [&](const void* buf, size_t len) -> bool {
+			hasher.update(buf, len);
+			length += len;
+			return true;
+		});
+
+		if(e.is_err())
+			return e;
+
+		auto sock_ = connect_to(*url);
+		if(sock_.is_err())
+			return Err(sock_.error());
+
+		auto sock = std::move(sock_.unwrap());
+		auto req = zpr::sprint("PUT {}/{}/{} HTTP/1.1\r\nHost: {}\r\nConnection: close\r\n"
+			"Content-Length: {}\r\nX-Vivano-Sha256: {}\r\n\r\n",
+			url->prefix, stage, key, url->host, length, hasher.hexdigest());
+
+		if(not sock.sendAll(req))
+			return ErrFmt("failed to send request");
+
+		if(auto e = pack(entry, [&](const void* buf, size_t len) { return sock.sendAll(buf, len); }); e.is_err())
+			return e;
+
+		auto resp = read_headers(sock);
+		if(not resp.has_value())
+			return ErrFmt("malformed response");
+
+		if(auto status = parse_status(resp->first_line); status < 200 || status >= 300)
+			return ErrFmt("server responded with '{}'", resp->first_line);
+
+		return Ok();
+	}
+
+
+	struct Uploader
+	{
+		struct Job
+		{
+			Config config;
+			std::string stage;
+			std::string key;
+		};
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<Job> queue;
+		std::thread worker;
+		size_t in_flight = 0;
+
+		void run()
+		{
+			while(true)
+			{
+				Job job {};
+				{
+					auto lk = std::unique_lock(this->mutex);
+					this->cv.wait(lk, [this]() { return not this->queue.empty(); });
+
+					job = std::move(this->queue.front());
+					this->queue.pop_front();
+				}
+
+				if(auto e = upload_one(job.config, job.stage, job.key); e.is_err())
+					vvn::warn("remote cache: failed to upload '{}/{}': {}", job.stage, job.key.substr(0, 12), e.error());
+
+				{
+					auto lk = std::unique_lock(this->mutex);
+					this->in_flight--;
+				}
+				this->cv.notify_all();
+			}
+		}
+	};
+
+	static Uploader* g_uploader = nullptr;
+
+	void upload_remote_async(const Config& config, std::string_view stage, std::string_view key)
+	{
+		// the worker is detached so that exit() doesn't have to join it; waitForUploads() is
+		// the only way to make sure that everything has actually been sent.
+		if(g_uploader == nullptr)
+		{
+			g_uploader = new Uploader();
+			g_uploader->worker = std::thread([]() { g_uploader->run(); });
+			g_uploader->worker.detach();
+		}
+
+		auto& u = *g_uploader;
+		{
+			auto lk = std::unique_lock(u.mutex);
+			u.queue.push_back({ config, std::string(stage), std::string(key) });
+			u.in_flight++;
+		}
+		u.cv.notify_all();
+	}
+
+	void waitForUploads()
+	{
+		if(g_uploader == nullptr)
+			return;
+
+		auto& u = *g_uploader;
+		auto lk = std::unique_lock(u.mutex);
+		if(u.in_flight == 0)
+			return;
+
+		vvn::log("waiting for {} upload(s) to the remote cache", u.in_flight);
+		u.cv.wait(lk, [&u]() { return u.in_flight == 0; });
+	}
+}
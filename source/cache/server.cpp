@@ -0,0 +1,229 @@
+// server.cpp
+// Copyright (c) 2022, zhiayang
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#include <thread>
+#include <filesystem>
+
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "args.h"
+#include "util.h"
+#include "cache.h"
+#include "vivano.h"
+#include "remote.h"
+
+using zst::Ok;
+using zst::Err;
+using zst::ErrFmt;
+using zst::Failable;
+
+namespace vvn::cache
+{
+	using namespace remote;
+
+	static constexpr int DEFAULT_SERVER_PORT = 8421;
+
+	static void respond(Socket& sock, int status, std::string_view reason, std::string_view body = "")
+	{
+		sock.sendAll(zpr::sprint("HTTP/1.1 {} {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+			status, reason, body.size(), body));
+	}
+
+	static void handle_get(Socket& sock, const stdfs::path& file, const stdfs::path& hash_file)
+	{
+		auto f = fopen(file.c_str(), "rb");
+		if(f == nullptr)
+			return respond(sock, 404, "Not Found");
+
+		std::error_code ec {};
+		auto size = stdfs::file_size(file, ec);
+		auto contents = util::readEntireFile(hash_file.string());
+		auto hash = std::string(util::trim(std::string_view(contents).substr(0, contents.find('\n'))));
+
+		sock.sendAll(zpr::sprint("HTTP/1.1 200 OK\r\nContent-Length: {}\r\nX-Vivano-Sha256: {}\r\n"
+			"Connection: close\r\n\r\n", size, hash));
+
+		char buf[64 * 1024];
+		while(true)
+		{
+			auto n = fread(&buf[0], 1, sizeof(buf), f);
+			if(n == 0 || not sock.sendAll(&buf[0], n))
+				break;
+		}
+
+		fclose(f);
+	}
+
+	static void handle_put(Socket& sock, const Request& req, const stdfs::path& file, const stdfs::path& hash_file)
+	{
+		auto expected_hash = req.header("x-vivano-sha256");
+		auto content_length = util::parseU64(req.header("content-length").value_or(""));
+		if(not expected_hash.has_value() || not content_length.has_value())
+			return respond(sock, 400, "Bad Request", "missing hash or length\n");
+
+		std::error_code ec {};
+		stdfs::create_directories(file.parent_path(), ec);
+
+		auto tmp = file;
+		tmp += zpr::sprint(".tmp-{}", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+		auto f = fopen(tmp.c_str(), "wb");
+		if(f == nullptr)
+			return respond(sock, 500, "Internal Server Error");
+
+		auto hasher = util::Sha256();
+		uint64_t remaining = *content_length;
+
+		char buf[64 * 1024];
+		while(remaining > 0)
+		{
+			auto n = sock.read(&buf[0], std::min(sizeof(buf), static_cast<size_t>(remaining)));
+			if(n == 0 || fwrite(&buf[0], 1, n, f) != n)
+				break;
+
+			hasher.update(&buf[0], n);
+			remaining -= n;
+		}
+
+		fclose(f);
+
+		if(remaining != 0)
+		{
+			stdfs::remove(tmp, ec);
+			return respond(sock, 400, "Bad Request", "truncated body\n");
+		}
+		else if(hasher.hexdigest() != *expected_hash)
+		{
+			stdfs::remove(tmp, ec);
+			return respond(sock, 400, "Bad Request", "hash mismatch\n");
+		}
+
+		// the hash file goes first, so that a GET never sees an entry without its hash.
+		if(auto hf = fopen(hash_file.c_str(), "wb"); hf != nullptr)
+		{
+			zpr::fprint(hf, "{}", *expected_hash);
+			fclose(hf);
+		}
+
+		stdfs::rename(tmp, file, ec);
+		if(ec)
+			return respond(sock, 500, "Internal Server Error");
+
+		respond(sock, 201, "Created");
+	}
+
+	static void handle_connection(Socket sock, const stdfs::path& root)
+	{
+		auto req = read_headers(sock);
+		if(not req.has_value())
+			return;
+
+		// "GET /synth/abcdef... HTTP/1.1". only the last two path components matter, so that
+		// clients can use any prefix they like in their url.
+		auto words = util::splitString(req->first_line, ' ');
+		if(words.size() != 3)
+			return respond(sock, 400, "Bad Request");
+
+		auto method = words[0];
+		auto parts = util::splitString(words[1], '/');
+		if(parts.size() < 2 || not valid_stage_and_key(parts[parts.size() - 2], parts.back()))
+			return respond(sock, 404, "Not Found");
+
+		auto stage = parts[parts.size() - 2];
+		auto key = parts.back();
+
+		auto file = root / stage / zpr::sprint("{}.pack", key);
+		auto hash_file = root / stage / zpr::sprint("{}.sha256", key);
+
+		if(method == "GET")
+			handle_get(sock, file, hash_file);
+		else if(method == "PUT")
+			handle_put(sock, *req, file, hash_file);
+		else
+			return respond(sock, 405, "Method Not Allowed");
+
+		zpr::println("{} {}/{}", method, stage, key.substr(0, 12));
+	}
+
+	Failable<std::string> runCacheServer(std::span<std::string_view> args)
+	{
+		if(args::check(args, args::HELP))
+		{
+			zpr::println(R"(
+usage: vvn cache serve [-p, --port <port>] [folder]
+
+Serves a shared build cache over HTTP, storing entries in 'folder'
+(default: ./vivano-cache). Point projects at it by setting
+"cache": { "remote": "http://<host>:<port>" } in vivano-project.json.
+)");
+			return Ok();
+		}
+
+		int port = DEFAULT_SERVER_PORT;
+		auto root = stdfs::path("vivano-cache");
+
+		for(size_t i = 0; i < args.size(); i++)
+		{
+			if(args[i] == args::PORT.first || args[i] == args::PORT.second)
+			{
+				if(i + 1 >= args.size() || not util::parseInt(args[i + 1]).has_value())
+					return ErrFmt("expected port number after '{}'", args[i]);
+
+				port = *util::parseInt(args[++i]);
+			}
+			else
+			{
+				root = args[i];
+			}
+		}
+
+		std::error_code ec {};
+		stdfs::create_directories(root, ec);
+		root = stdfs::absolute(root, ec);
+
+		auto fd = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if(fd < 0)
+			return ErrFmt("socket(): {}", strerror(errno));
+
+		int yes = 1;
+		int no = 0;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+		setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &no, sizeof(no));
+
+		struct sockaddr_in6 addr {};
+		addr.sin6_family = AF_INET6;
+		addr.sin6_addr = in6addr_any;
+		addr.sin6_port = htons(static_cast<uint16_t>(port));
+
+		if(bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0)
+			return ErrFmt("could not bind to port {}: {}", port, strerror(errno));
+
+		if(listen(fd, 64) < 0)
+			return ErrFmt("listen(): {}", strerror(errno));
+
+		vvn::log("serving build cache from '{}' on port {}", root.string(), port);
+		while(true)
+		{
+			auto client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+			if(client < 0)
+			{
+				if(errno == EINTR || errno == ECONNABORTED)
+					continue;
+
+				return ErrFmt("accept(): {}", strerror(errno));
+			}
+
+			set_timeouts(client);
+			std::thread([client, root]() {
+				handle_connection(Socket(client), root);
+			}).detach();
+		}
+	}
+}
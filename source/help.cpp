@@ -27,6 +27,7 @@ Commands:
     impl            perform implementation
     bitstream       write the bitstream
     ip              perform IP operations
+    cache           manage the local build cache
 )");
 	}
 
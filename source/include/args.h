@@ -26,6 +26,7 @@ namespace vvn
 		static constexpr Arg USE_STALE      = { "-s", "--stale" };
 		static constexpr Arg ALL            = { "-a", "--all" };
 		static constexpr Arg IPS            = { "-i", "--ips" };
+		static constexpr Arg PORT           = { "-p", "--port" };
 	}
 
 	static constexpr std::string_view CMD_HELP          = "help";
@@ -54,4 +55,10 @@ namespace vvn
 	static constexpr std::string_view CMD_BD_CLEAN      = "clean";
 	static constexpr std::string_view CMD_BD_CREATE     = "create";
 	static constexpr std::string_view CMD_BD_DELETE     = "delete";
+
+	static constexpr std::string_view CMD_CACHE         = "cache";
+	static constexpr std::string_view CMD_CACHE_INFO    = "info";
+	static constexpr std::string_view CMD_CACHE_GC      = "gc";
+	static constexpr std::string_view CMD_CACHE_CLEAR   = "clear";
+	static constexpr std::string_view CMD_CACHE_SERVE   = "serve";
 }
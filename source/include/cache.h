@@ -0,0 +1,85 @@
+// cache.h
+// Copyright (c) 2022, zhiayang
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#include <zst.h>
+
+namespace stdfs = std::filesystem;
+
+namespace vvn
+{
+	struct Project;
+}
+
+namespace vvn::cache
+{
+	static constexpr std::string_view STAGE_IP         = "ip";
+	static constexpr std::string_view STAGE_SYNTH      = "synth";
+	static constexpr std::string_view STAGE_IMPL       = "impl";
+	static constexpr std::string_view STAGE_BITSTREAM  = "bitstream";
+
+	/*
+		An artifact is a single file or directory that is produced by a build stage. The `name` is used
+		as the filename inside the cache entry, and `path` is where the artifact lives in the project.
+	*/
+	struct Artifact
+	{
+		std::string name;
+		stdfs::path path;
+	};
+
+	struct Config
+	{
+		bool enabled;
+		stdfs::path location;
+		uint64_t max_size;
+
+		// eg. "http://build-cache:8421"; empty if there's no shared cache
+		std::string remote_url;
+		bool remote_upload;
+	};
+
+	/*
+		Returns true if every artifact was restored from the cache entry for `key`. On a partial
+		restore, nothing is left behind in the project.
+	*/
+	bool restore(const Project& proj, std::string_view stage, const std::string& key,
+		const std::vector<Artifact>& artifacts);
+
+	/*
+		Inserts the given artifacts into the cache under `key`, then evicts the least-recently used
+		entries until the cache fits under its size limit. Failures are not fatal to the build, so
+		they are only reported as warnings.
+	*/
+	void store(const Project& proj, std::string_view stage, const std::string& key,
+		const std::vector<Artifact>& artifacts);
+
+	void collectGarbage(const Config& config);
+
+	zst::Failable<std::string> runCacheCommand(const Project& proj, std::span<std::string_view> args);
+
+	// runs until killed; this doesn't need a project.
+	zst::Failable<std::string> runCacheServer(std::span<std::string_view> args);
+
+	// blocks until all queued uploads to the remote cache have finished (or failed).
+	void waitForUploads();
+
+	static constexpr const char* ENTRY_SIZE_FILENAME = ".size";
+	static constexpr const char* TMP_FOLDER_NAME = ".tmp";
+
+	stdfs::path entry_path(const Config& config, std::string_view stage, std::string_view key);
+	stdfs::path make_temp_entry(const Config& config, std::string_view key);
+	bool commit_entry(const Config& config, std::string_view stage, std::string_view key, const stdfs::path& tmp);
+
+	bool fetch_remote(const Config& config, std::string_view stage, std::string_view key);
+	void upload_remote_async(const Config& config, std::string_view stage, std::string_view key);
+}
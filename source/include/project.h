@@ -19,6 +19,7 @@
 #include <zst.h>
 
 #include "util.h"
+#include "cache.h"
 #include "msgconfig.h"
 
 namespace stdfs = std::filesystem;
@@ -80,6 +81,8 @@ namespace vvn
 
 		} bd_config;
 
+		cache::Config cache_config;
+
 		MsgConfig messages_config;
 	};
 
@@ -89,6 +92,7 @@ namespace vvn
 	zst::Result<void, std::string> writeDefaultProjectJson(const std::string& part, const std::string& proj);
 
 	struct Vivado;
+	struct Project;
 
 	struct IpInstance
 	{
@@ -99,6 +103,8 @@ namespace vvn
 
 		bool shouldRegenerate() const;
 		bool shouldResynthesise() const;
+
+		std::string cacheKey(const Project& proj) const;
 	};
 
 	struct BdInstance
@@ -137,10 +143,14 @@ namespace vvn
 		}
 
 		const MsgConfig& getMsgConfig() const { return m_msg_config; }
+		const cache::Config& getCacheConfig() const { return m_cache_config; }
 
 		const std::string& getPartName() const { return m_part_name; }
 		const std::string& getProjectName() const { return m_project_name; }
 
+		stdfs::path getVivadoInstallDir() const { return m_vivado_dir; }
+		const std::vector<stdfs::path>& getTclScripts() const { return m_tcl_scripts; }
+
 		stdfs::path getBuildFolder() const { return m_build_folder; }
 		stdfs::path getProjectLocation() const { return m_location; }
 
@@ -169,6 +179,10 @@ namespace vvn
 
 		stdfs::path get_bitstream_name() const;
 
+		std::string synthesis_key() const;
+		std::string implementation_key() const;
+		std::string bitstream_key() const;
+
 		std::string m_project_name;
 		std::string m_part_name;
 		std::string m_top_module;
@@ -190,6 +204,7 @@ namespace vvn
 		std::string m_implemented_dcp_name;
 
 		MsgConfig m_msg_config;
+		cache::Config m_cache_config;
 
 		// in-memory state
 		std::vector<std::string> m_vhdl_sources;
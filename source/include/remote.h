@@ -0,0 +1,65 @@
+// remote.h
+// Copyright (c) 2022, zhiayang
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <functional>
+#include <filesystem>
+#include <string_view>
+
+#include <zst.h>
+
+#include "util.h"
+
+namespace stdfs = std::filesystem;
+
+// bits shared by the remote cache client and `vvn cache serve`
+namespace vvn::cache::remote
+{
+	struct Socket
+	{
+		explicit Socket(int fd) : fd(fd) { }
+		~Socket();
+
+		Socket(Socket&& other);
+		Socket& operator= (Socket&&) = delete;
+
+		bool sendAll(std::string_view sv);
+		bool sendAll(const void* data, size_t len);
+
+		size_t read(void* into, size_t len);
+		bool readExactly(void* into, size_t len);
+		std::optional<std::string> readLine(size_t max_len = 8192);
+
+		int fd = -1;
+
+	private:
+		bool fill();
+
+		char m_buffer[16 * 1024];
+		size_t m_pos = 0;
+		size_t m_len = 0;
+	};
+
+	struct Request
+	{
+		// either the request line (for the server) or the status line (for the client)
+		std::string first_line;
+
+		// names are lowercased
+		util::hashmap<std::string, std::string> headers;
+
+		std::optional<std::string> header(const std::string& name) const;
+	};
+
+	void set_timeouts(int fd);
+	std::optional<Request> read_headers(Socket& sock);
+	bool valid_stage_and_key(std::string_view stage, std::string_view key);
+
+	zst::Failable<std::string> pack(const stdfs::path& entry, const std::function<bool (const void*, size_t)>& sink);
+	zst::Failable<std::string> unpack(const stdfs::path& dest, const std::function<std::optional<std::string> ()>& read_line,
+		const std::function<bool (void*, size_t)>& read_bytes);
+}
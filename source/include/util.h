@@ -82,11 +82,33 @@ namespace util
 	std::string lowercase(std::string_view sv);
 
 	std::optional<int> parseInt(std::string_view sv);
+	std::optional<uint64_t> parseU64(std::string_view sv);
 
 	std::string readEntireFile(std::string_view path);
 	std::vector<std::string_view> splitString(std::string_view str, char delim);
 	std::string_view trim(std::string_view sv);
 
+	struct Sha256
+	{
+		Sha256();
+
+		Sha256& update(std::string_view sv);
+		Sha256& update(const void* data, size_t len);
+
+		// note: this finalises the hash; don't call update() afterwards.
+		std::string hexdigest();
+
+	private:
+		void compress(const uint8_t* block);
+
+		uint32_t m_state[8] {};
+		uint8_t m_buffer[64] {};
+		size_t m_buffered = 0;
+		uint64_t m_length = 0;
+	};
+
+	std::optional<std::string> hashFile(const stdfs::path& path);
+
 	std::vector<stdfs::path> find_files_ext(const stdfs::path& dir, std::string_view ext);
 	std::vector<stdfs::path> find_files_ext_recursively(const stdfs::path& dir, std::string_view ext);
 
@@ -4,6 +4,7 @@
 
 #include "ip.h"
 #include "util.h"
+#include "cache.h"
 #include "vivado.h"
 #include "vivano.h"
 #include "project.h"
@@ -95,8 +96,20 @@ namespace vvn::ip
 		auto _ = vvn::LogIndenter();
 		zpr::println("{}+ {}{}", vvn::indentStr(), ip.is_global ? "(global) " : "", ip.name);
 
+		bool regenerate = ip.shouldRegenerate();
+		bool resynthesise = ip.shouldResynthesise();
 
-		if(ip.shouldRegenerate())
+		std::string cache_key {};
+		auto artifacts = std::vector<cache::Artifact> { { ip.name, ip.xci.parent_path() } };
+
+		if(resynthesise)
+		{
+			cache_key = ip.cacheKey(proj);
+			if(cache::restore(proj, cache::STAGE_IP, cache_key, artifacts))
+				regenerate = false, resynthesise = false;
+		}
+
+		if(regenerate)
 		{
 			if(auto e = regenerate_ip_instance(vivado, ip, proj.getMsgConfig()); e.is_err())
 				return Err(e.error());
@@ -122,10 +135,12 @@ namespace vvn::ip
 			}
 		}
 
-		if(ip.shouldResynthesise())
+		if(resynthesise)
 		{
 			if(auto e = synthesise_ip_instance(vivado, ip, proj.getMsgConfig()); e.is_err())
 				return Err(e.error());
+
+			cache::store(proj, cache::STAGE_IP, cache_key, artifacts);
 		}
 		else if(ip.is_global)
 		{
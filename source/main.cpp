@@ -16,6 +16,7 @@
 #include "bd.h"
 #include "args.h"
 #include "util.h"
+#include "cache.h"
 #include "help.h"
 #include "vivano.h"
 #include "vivado.h"
@@ -39,6 +40,10 @@ static Result<void, std::string> run_subcommand(vvn::Project& project, std::stri
 	{
 		return vvn::bd::runBdCommand(project, args);
 	}
+	else if(command == vvn::CMD_CACHE)
+	{
+		return vvn::cache::runCacheCommand(project, args);
+	}
 	else if(command == vvn::CMD_CHECK)
 	{
 		if(args::check(args, args::HELP))
@@ -137,6 +142,14 @@ int main(int argc, char** argv)
 		vvn::createProject(args);
 		exit(0);
 	}
+	else if(command == vvn::CMD_CACHE && args.size() > 0 && args[0] == vvn::CMD_CACHE_SERVE)
+	{
+		auto result = vvn::cache::runCacheServer(std::span(args).subspan(1));
+		if(result.is_err())
+			vvn::error("{}\n", result.error());
+
+		exit(result.is_err() ? 1 : 0);
+	}
 
 	// try to read a vivano-project.json
 	auto config_or_err = vvn::parseProjectJson(vvn::PROJECT_JSON_FILENAME);
@@ -145,6 +158,7 @@ int main(int argc, char** argv)
 
 	auto project = vvn::Project(config_or_err.unwrap());
 	auto result = run_subcommand(project, command, args);
+	vvn::cache::waitForUploads();
 
 	if(result.is_err())
 		vvn::error("{}\n", result.error());
@@ -37,6 +37,9 @@ namespace defaults
 	constexpr std::string_view SYNTHESISED_DCP  = "synthesised.dcp";
 	constexpr std::string_view IMPLEMENTED_DCP  = "implemented.dcp";
 
+	constexpr bool CACHE_ENABLED                = true;
+	constexpr int64_t CACHE_MAX_SIZE_MB         = 50 * 1024;
+
 	constexpr int MIN_MESSAGE_SEVERITY          = 0;
 	constexpr int MIN_IP_MESSAGE_SEVERITY       = 2;
 	constexpr bool PRINT_MESSAGE_IDS            = true;
@@ -89,7 +92,6 @@ namespace vvn
 			return Ok(std::string(default_value));
 	}
 
-#if 0
 	static Result<int64_t, std::string> read_int(const pj::object& dict, const std::string& key,
 		int64_t default_value)
 	{
@@ -105,7 +107,6 @@ namespace vvn
 			return Ok(default_value);
 		}
 	}
-#endif
 
 	static Result<bool, std::string> read_boolean(const pj::object& dict, const std::string& key,
 		bool default_value)
@@ -304,6 +305,75 @@ namespace vvn
 
 
 
+	static Result<void, std::string> parseCacheJson(ProjectConfig& project, const pj::object& dict)
+	{
+		auto& cache = project.cache_config;
+
+		// follow the XDG spec for the default location
+		if(auto xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && *xdg != '\0')
+			cache.location = stdfs::path(xdg) / "vivano";
+		else
+			cache.location = util::getHomeFolder() / ".cache" / "vivano";
+
+		cache.enabled = defaults::CACHE_ENABLED;
+		cache.remote_upload = true;
+		cache.max_size = static_cast<uint64_t>(defaults::CACHE_MAX_SIZE_MB) * 1024 * 1024;
+
+		if(auto foo = dict.find("cache"); foo != dict.end())
+		{
+			if(not foo->second.is_obj())
+				return ErrFmt("expected object for key 'cache'");
+
+			auto& obj = foo->second.as_obj();
+			{
+				auto foo = read_boolean(obj, "enabled", defaults::CACHE_ENABLED);
+				if(foo.is_err())
+					return Err(foo.error());
+				cache.enabled = foo.unwrap();
+			}
+
+			{
+				auto foo = read_string(obj, "location", "");
+				if(foo.is_err())
+					return Err(foo.error());
+
+				if(auto s = foo.unwrap(); s.starts_with("~/") || s.starts_with("~\\"))
+					cache.location = util::getHomeFolder() / s.substr(2);
+				else if(not s.empty())
+					cache.location = project.location / s;
+			}
+
+			{
+				auto foo = read_int(obj, "max_size_mb", defaults::CACHE_MAX_SIZE_MB);
+				if(foo.is_err())
+					return Err(foo.error());
+				else if(foo.unwrap() < 0)
+					return ErrFmt("'max_size_mb' cannot be negative");
+
+				cache.max_size = static_cast<uint64_t>(foo.unwrap()) * 1024 * 1024;
+			}
+
+			{
+				auto foo = read_string(obj, "remote", "");
+				if(foo.is_err())
+					return Err(foo.error());
+				else if(not foo->empty() && not foo->starts_with("http://"))
+					return ErrFmt("remote cache url must start with 'http://'");
+
+				cache.remote_url = foo.unwrap();
+			}
+
+			{
+				auto foo = read_boolean(obj, "remote_upload", true);
+				if(foo.is_err())
+					return Err(foo.error());
+				cache.remote_upload = foo.unwrap();
+			}
+		}
+
+		return Ok();
+	}
+
 	static Result<void, std::string> parseMessagesJson(ProjectConfig& project, const pj::object& dict)
 	{
 		auto& msg = project.messages_config;
@@ -511,6 +581,9 @@ namespace vvn
 		if(auto x = parseBdJson(proj, json_top); x.is_err())
 			return Err(x.error());
 
+		if(auto x = parseCacheJson(proj, json_top); x.is_err())
+			return Err(x.error());
+
 		if(auto x = parseMessagesJson(proj, json_top); x.is_err())
 			return Err(x.error());
 
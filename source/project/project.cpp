@@ -77,6 +77,7 @@ namespace vvn
 		m_bd_folder = config.bd_config.location;
 		m_bd_output_folder = m_bd_folder / config.bd_config.output_subdir;
 
+		m_cache_config = config.cache_config;
 		m_msg_config = config.messages_config;
 		m_msg_config.project_path = m_location;
 		m_synthesised_dcp_name = config.synthesised_dcp_name;
@@ -0,0 +1,155 @@
+// sha256.cpp
+// Copyright (c) 2022, zhiayang
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstdio>
+#include <cstring>
+
+#include <zpr.h>
+
+#include "util.h"
+
+namespace util
+{
+	static constexpr uint32_t ROUND_CONSTANTS[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+	};
+
+	static inline uint32_t rotr(uint32_t x, int n)
+	{
+		return (x >> n) | (x << (32 - n));
+	}
+
+	Sha256::Sha256()
+	{
+		m_state[0] = 0x6a09e667; m_state[1] = 0xbb67ae85;
+		m_state[2] = 0x3c6ef372; m_state[3] = 0xa54ff53a;
+		m_state[4] = 0x510e527f; m_state[5] = 0x9b05688c;
+		m_state[6] = 0x1f83d9ab; m_state[7] = 0x5be0cd19;
+	}
+
+	void Sha256::compress(const uint8_t* block)
+	{
+		uint32_t w[64] {};
+		for(size_t i = 0; i < 16; i++)
+		{
+			w[i] = (uint32_t(block[4*i + 0]) << 24) | (uint32_t(block[4*i + 1]) << 16)
+				| (uint32_t(block[4*i + 2]) << 8) | uint32_t(block[4*i + 3]);
+		}
+
+		for(size_t i = 16; i < 64; i++)
+		{
+			auto s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			auto s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+		uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+
+		for(size_t i = 0; i < 64; i++)
+		{
+			auto s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+			auto ch = (e & f) ^ (~e & g);
+			auto t1 = h + s1 + ch + ROUND_CONSTANTS[i] + w[i];
+			auto s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+			auto maj = (a & b) ^ (a & c) ^ (b & c);
+			auto t2 = s0 + maj;
+
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		}
+
+		m_state[0] += a; m_state[1] += b; m_state[2] += c; m_state[3] += d;
+		m_state[4] += e; m_state[5] += f; m_state[6] += g; m_state[7] += h;
+	}
+
+	Sha256& Sha256::update(const void* data, size_t len)
+	{
+		auto bytes = static_cast<const uint8_t*>(data);
+		m_length += len;
+
+		while(len > 0)
+		{
+			auto n = std::min(len, sizeof(m_buffer) - m_buffered);
+			memcpy(&m_buffer[m_buffered], bytes, n);
+
+			m_buffered += n;
+			bytes += n;
+			len -= n;
+
+			if(m_buffered == sizeof(m_buffer))
+			{
+				this->compress(&m_buffer[0]);
+				m_buffered = 0;
+			}
+		}
+
+		return *this;
+	}
+
+	Sha256& Sha256::update(std::string_view sv)
+	{
+		// include the length, so that ("ab", "c") and ("a", "bc") hash differently.
+		auto len = static_cast<uint64_t>(sv.size());
+		this->update(&len, sizeof(len));
+		return this->update(sv.data(), sv.size());
+	}
+
+	std::string Sha256::hexdigest()
+	{
+		auto bit_length = m_length * 8;
+
+		uint8_t pad = 0x80;
+		this->update(&pad, 1);
+
+		pad = 0;
+		while(m_buffered != 56)
+			this->update(&pad, 1);
+
+		uint8_t length_bytes[8] {};
+		for(size_t i = 0; i < 8; i++)
+			length_bytes[i] = static_cast<uint8_t>(bit_length >> (56 - 8 * i));
+
+		this->update(&length_bytes[0], 8);
+
+		std::string ret {};
+		for(auto word : m_state)
+			ret += zpr::sprint("{08x}", word);
+
+		return ret;
+	}
+
+	std::optional<std::string> hashFile(const stdfs::path& path)
+	{
+		auto f = fopen(path.c_str(), "rb");
+		if(f == nullptr)
+			return std::nullopt;
+
+		auto hasher = Sha256();
+		char buf[64 * 1024];
+		while(true)
+		{
+			auto did_read = fread(&buf[0], 1, sizeof(buf), f);
+			if(did_read == 0)
+				break;
+
+			hasher.update(&buf[0], did_read);
+		}
+
+		bool failed = ferror(f);
+		fclose(f);
+
+		if(failed)
+			return std::nullopt;
+
+		return hasher.hexdigest();
+	}
+}
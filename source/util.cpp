@@ -106,6 +106,15 @@ namespace util
 			return std::nullopt;
 	}
 
+	std::optional<uint64_t> parseU64(std::string_view sv)
+	{
+		uint64_t x = 0;
+		if(std::from_chars(sv.begin(), sv.end(), x).ec == std::errc{})
+			return x;
+		else
+			return std::nullopt;
+	}
+
 	std::string lowercase(std::string_view sv)
 	{
 		auto ret = std::string(sv);